@@ -3,9 +3,15 @@
 #include <windowsx.h>
 #include <vector>
 #include <string>
-#include <sstream>
+#include <cstring>
+#include <memory>
 #include <algorithm>
 #include <map>
+#ifdef GEN_BENCH
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#endif
 
 using namespace std;
 
@@ -243,8 +249,211 @@ void InitTemplates() {
     templates.emplace_back(BLOCK_WIDE_CHAR, "wchar_t 宽字符变量;", "", 20, 1070, true, false);
 }
 
+//===== 代码生成 =====
+const size_t GEN_CHUNK_MIN = 4096;  // 每个线程至少负责的代码块数量，太少时开线程得不偿失
+const size_t GEN_THREADS_MAX = MAXIMUM_WAIT_OBJECTS;
+int genThreadCount = 0;             // 代码生成线程数，0 表示按 CPU 核心数自动选择
+
+// 排序用的键，把坐标拷出来，排序时不必再逐个访问分散的 CodeBlock
+struct GenKey {
+    int y, x;
+    const CodeBlock* block;
+};
+
+// 一段连续代码块的生成任务，格式化到本段自己的缓冲区
+struct GenChunk {
+    const GenKey* begin;
+    const GenKey* end;
+    unique_ptr<char[]> text;        // 前 headLen 字节是头部，后 bodyLen 字节是主函数内部
+    size_t headLen;
+    size_t bodyLen;
+    const CodeBlock* firstMain;     // 本段第一个主函数块
+};
+
+// 往 dst 追加一段文本并返回长度，dst 为空时只计数
+static size_t PutText(char* dst, const char* s, size_t n) {
+    if (dst) memcpy(dst, s, n);
+    return n;
+}
+
+// 单个代码块在头部的输出
+static size_t EmitHead(const CodeBlock& block, char* dst) {
+    size_t n = 0;
+    if (block.type == BLOCK_INCLUDE) {
+        n += PutText(dst, block.content.data(), block.content.size());
+        n += PutText(dst ? dst + n : nullptr, "\n", 1);
+    } else if (block.type == BLOCK_USING_NAMESPACE) {
+        n += PutText(dst, block.content.data(), block.content.size());
+        n += PutText(dst ? dst + n : nullptr, "\n\n", 2);
+    }
+    return n;
+}
+
+// 单个代码块在主函数内部的输出
+static size_t EmitBody(const CodeBlock& block, char* dst) {
+    if (block.type == BLOCK_INCLUDE || block.type == BLOCK_USING_NAMESPACE ||
+        block.type == BLOCK_MAIN) return 0;
+
+    size_t n = 0;
+    if (block.type == BLOCK_RETURN) {
+        // 跳过 "return "；内容不足 7 个字符时输出空的 return，而不是像 substr(7) 那样抛异常
+        size_t skip = min<size_t>(7, block.content.size());
+        n += PutText(dst, "    return ", 11);
+        n += PutText(dst ? dst + n : nullptr, block.content.data() + skip, block.content.size() - skip);
+        n += PutText(dst ? dst + n : nullptr, ";\n", 2);
+    } else {
+        n += PutText(dst, "    ", 4);
+        n += PutText(dst ? dst + n : nullptr, block.content.data(), block.content.size());
+        n += PutText(dst ? dst + n : nullptr, "\n", 1);
+    }
+    return n;
+}
+
+// 先算出本段的长度，再一次分配好缓冲区写入
+static void FormatGenChunk(GenChunk* chunk) {
+    size_t head = 0, body = 0;
+    chunk->firstMain = nullptr;
+    for (const GenKey* it = chunk->begin; it != chunk->end; ++it) {
+        head += EmitHead(*it->block, nullptr);
+        body += EmitBody(*it->block, nullptr);
+        if (!chunk->firstMain && it->block->type == BLOCK_MAIN) chunk->firstMain = it->block;
+    }
+    chunk->headLen = head;
+    chunk->bodyLen = body;
+    chunk->text.reset(new char[head + body]);
+
+    char* dst = chunk->text.get();
+    head = 0;
+    body = chunk->headLen;
+    for (const GenKey* it = chunk->begin; it != chunk->end; ++it) {
+        head += EmitHead(*it->block, dst + head);
+        body += EmitBody(*it->block, dst + body);
+    }
+}
+
+// 常驻的工作线程：第一次用到时创建，之后每次生成只用事件唤醒，拖动时不会反复开关线程
+struct GenWorker {
+    HANDLE start;       // 置位后处理 chunk
+    HANDLE done;        // 处理完后置位
+    GenChunk* chunk;
+};
+static GenWorker genWorkers[GEN_THREADS_MAX];
+static size_t genWorkerCount = 0;
+
+static DWORD WINAPI GenWorkerProc(LPVOID param) {
+    GenWorker* worker = (GenWorker*)param;
+    for (;;) {
+        WaitForSingleObject(worker->start, INFINITE);
+        FormatGenChunk(worker->chunk);
+        SetEvent(worker->done);
+    }
+    return 0;
+}
+
+static bool AddGenWorker() {
+    if (genWorkerCount == GEN_THREADS_MAX) return false;
+    GenWorker& worker = genWorkers[genWorkerCount];
+    worker.start = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    worker.done = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    HANDLE h = (worker.start && worker.done) ?
+        CreateThread(nullptr, 0, GenWorkerProc, &worker, 0, nullptr) : nullptr;
+    if (!h) {
+        if (worker.start) CloseHandle(worker.start);
+        if (worker.done) CloseHandle(worker.done);
+        return false;
+    }
+    CloseHandle(h);
+    ++genWorkerCount;
+    return true;
+}
+
+// 第一段在当前线程执行，其余各段交给工作线程
+static void RunGenChunks(vector<GenChunk>& chunks) {
+    HANDLE done[GEN_THREADS_MAX];
+    size_t used = 0;
+    for (size_t i = 1; i < chunks.size(); ++i) {
+        if (used == genWorkerCount && !AddGenWorker()) {
+            FormatGenChunk(&chunks[i]);
+            continue;
+        }
+        genWorkers[used].chunk = &chunks[i];
+        done[used] = genWorkers[used].done;
+        SetEvent(genWorkers[used].start);
+        ++used;
+    }
+    FormatGenChunk(&chunks[0]);
+    if (used) WaitForMultipleObjects((DWORD)used, done, TRUE, INFINITE);
+}
+
+// 按位置排序，比较规则与原来对 CodeBlock 排序时相同，所以排出的顺序也相同
+static void SortGenKeys(vector<GenKey>& keys) {
+    keys.clear();
+    keys.reserve(blocks.size());
+    for (const CodeBlock& block : blocks) keys.push_back({block.y, block.x, &block});
+    sort(keys.begin(), keys.end(), [](const GenKey& a, const GenKey& b) {
+        return a.y < b.y || (a.y == b.y && a.x < b.x);
+    });
+}
+
+// 按排序后的顺序切成连续的若干段
+static void SplitGenChunks(const vector<GenKey>& keys, vector<GenChunk>& chunks) {
+    size_t threadCount = genThreadCount > 0 ? genThreadCount : 0;
+    if (threadCount == 0) {
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        threadCount = si.dwNumberOfProcessors;
+    }
+    threadCount = min(threadCount, keys.size() / GEN_CHUNK_MIN);
+    threadCount = max<size_t>(1, min(threadCount, GEN_THREADS_MAX));
+
+    chunks.clear();
+    chunks.resize(threadCount);
+    const GenKey* base = keys.data();
+    for (size_t i = 0; i < threadCount; ++i) {
+        chunks[i].begin = base + keys.size() * i / threadCount;
+        chunks[i].end = base + keys.size() * (i + 1) / threadCount;
+    }
+}
+
+// 按“头部、固定部分、主函数内部”的顺序把各段拼进 debugCode
+static void JoinGenChunks(const vector<GenChunk>& chunks) {
+    const CodeBlock* mainBlock = nullptr;
+    for (const GenChunk& chunk : chunks) {
+        if (chunk.firstMain) {
+            mainBlock = chunk.firstMain;
+            break;
+        }
+    }
+
+    string middle = "// 用户代码\n\n";
+    if (mainBlock) middle += mainBlock->content + "\n\n";
+    else middle += "// 请从模板区拖拽代码块开始构建你的程序\n";
+    middle += "// 主函数内部\n";
+
+    size_t total = middle.size();
+    for (const GenChunk& chunk : chunks) total += chunk.headLen + chunk.bodyLen;
+
+    // clear 保留原有容量，reserve 后逐段 append，每个字节只拷贝一次，也不用先清零
+    debugCode.clear();
+    debugCode.reserve(total);
+    for (const GenChunk& chunk : chunks) debugCode.append(chunk.text.get(), chunk.headLen);
+    debugCode += middle;
+    for (const GenChunk& chunk : chunks) debugCode.append(chunk.text.get() + chunk.headLen, chunk.bodyLen);
+}
+
 // 生成代码
 void GenerateCode() {
+    vector<GenKey> keys;
+    vector<GenChunk> chunks;
+    SortGenKeys(keys);
+    SplitGenChunks(keys, chunks);
+    RunGenChunks(chunks);
+    JoinGenChunks(chunks);
+}
+
+#ifdef GEN_BENCH
+// 原来的单线程实现，作为对照
+static void GenerateCodeSerial() {
     stringstream ss;
     vector<CodeBlock> sortedBlocks = blocks;
     sort(sortedBlocks.begin(), sortedBlocks.end(), [](const CodeBlock& a, const CodeBlock& b) {
@@ -290,6 +499,77 @@ void GenerateCode() {
     debugCode = ss.str();
 }
 
+static double ElapsedMs(const LARGE_INTEGER& from, const LARGE_INTEGER& to, const LARGE_INTEGER& freq) {
+    return (to.QuadPart - from.QuadPart) * 1000.0 / freq.QuadPart;
+}
+
+// 代码生成基准：随机摆放模板代码块，分别统计排序、格式化、拼接三个阶段在 1..N 线程下的耗时，
+// 并检查输出与单线程实现一致。用 -DGEN_BENCH 编译后以 --bench 参数运行，结果写入 bench_output.txt
+static void RunGenBench() {
+    FILE* f = fopen("bench_output.txt", "w");
+    if (!f) return;
+
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    int maxThreads = (int)min<size_t>(si.dwNumberOfProcessors, GEN_THREADS_MAX);
+
+    LARGE_INTEGER freq;
+    QueryPerformanceFrequency(&freq);
+
+    InitTemplates();
+    const size_t sizes[] = {0, 1, 100, 5000, 50000, 300000};
+    bool allSame = true;
+    for (size_t n : sizes) {
+        // 纵坐标取值范围与块数相当，保证有坐标相同的块，顺带检查相同坐标的排序结果
+        srand((unsigned)n);
+        blocks.clear();
+        for (size_t i = 0; i < n; ++i) {
+            CodeBlock block = templates[rand() % templates.size()];
+            block.isTemplate = false;
+            block.x = SIDEBAR_W + 20 + rand() % 8 * 60;
+            block.y = (int)(((size_t)rand() * (RAND_MAX + 1u) + rand()) % (n + 1));
+            blocks.push_back(block);
+        }
+
+        LARGE_INTEGER t0, t1, t2, t3, t4;
+        QueryPerformanceCounter(&t0);
+        GenerateCodeSerial();
+        QueryPerformanceCounter(&t1);
+        string expected = debugCode;
+        fprintf(f, "blocks=%lu serial total=%.2fms\n", (unsigned long)n, ElapsedMs(t0, t1, freq));
+
+        for (int threads = 1; threads <= maxThreads; ++threads) {
+            genThreadCount = threads;
+            vector<GenKey> keys;
+            vector<GenChunk> chunks;
+            QueryPerformanceCounter(&t0);
+            SortGenKeys(keys);
+            QueryPerformanceCounter(&t1);
+            SplitGenChunks(keys, chunks);
+            RunGenChunks(chunks);
+            QueryPerformanceCounter(&t2);
+            JoinGenChunks(chunks);
+            QueryPerformanceCounter(&t3);
+            chunks.clear();
+            QueryPerformanceCounter(&t4);
+
+            bool same = debugCode == expected;
+            allSame = allSame && same;
+            fprintf(f, "blocks=%lu threads=%d sort=%.2fms format=%.2fms join=%.2fms free=%.2fms total=%.2fms %s\n",
+                    (unsigned long)n, threads, ElapsedMs(t0, t1, freq), ElapsedMs(t1, t2, freq),
+                    ElapsedMs(t2, t3, freq), ElapsedMs(t3, t4, freq), ElapsedMs(t0, t4, freq),
+                    same ? "OK" : "MISMATCH");
+        }
+    }
+    fprintf(f, allSame ? "全部一致\n" : "存在不一致的输出\n");
+    fclose(f);
+
+    genThreadCount = 0;
+    blocks.clear();
+    debugCode.clear();
+}
+#endif
+
 // 磁吸对齐
 void MagneticAlignment(int& newX, int& newY) {
     newX = max(SIDEBAR_W + 20, min(newX, SIDEBAR_W + WORK_AREA_W - 240));
@@ -642,7 +922,14 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp) {
 }
 
 // 程序入口
-int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int nCmdShow) {
+int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR lpCmdLine, int nCmdShow) {
+#ifdef GEN_BENCH
+    if (strstr(lpCmdLine, "--bench")) {
+        RunGenBench();
+        return 0;
+    }
+#endif
+
     WNDCLASS wc = {};
     wc.lpfnWndProc = WndProc;
     wc.hInstance = hInst;